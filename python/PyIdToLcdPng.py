@@ -63,18 +63,39 @@ def converForPngDataArray(png_data, lcdPartern_str):
     image. Each row is represented as a list of integers, where each integer represents the color value
     of a pixel
     :param lcdPartern_str: The lcdPartern_str parameter is a string that represents a pattern of LCD
-    pixels. Each character in the string represents a pixel, where '0' represents an off pixel and any
-    other character represents an on pixel
+    pixels from left to right. Each character in the string represents a pixel, where '0' represents
+    an off pixel and any other character represents an on pixel
     """
     png_row = []
     png_data.append(png_row)
     
-    for c in reversed(lcdPartern_str):
+    for c in lcdPartern_str:
         if c == '0':
             png_row.append(0xFF)
         else:
             png_row.append(0x0)
 
+def convertToPngData(idWithChecksum_str):
+    """
+    The function `convertToPngData` converts an ID with checksum to the pixel rows of the PNG image,
+    in the same layout as the C++ version: one blank byte first, then the LCD pattern of each digit
+    from its most significant bit, and blank pixels up to the width of 256.
+    
+    :param idWithChecksum_str: The parameter `idWithChecksum_str` is a string that represents an ID with
+    a checksum
+    :return: the list of pixel rows, or an empty list if the ID can't be converted to LCD pattern
+    """
+    lcdPartern_number = convertToLcdPartern(idWithChecksum_str)
+    if lcdPartern_number == 0:
+        return []
+
+    lcdPartern_str = format(lcdPartern_number, f"0{len(idWithChecksum_str) * 8}b")
+    lcdPartern_str = ("0" * 8 + lcdPartern_str).ljust(256, "0")
+
+    png_data = []
+    converForPngDataArray(png_data, lcdPartern_str)
+    return png_data
+
 def process_file(filename, output_dir):
     """
     The `process_file` function reads a file line by line, checks if each line is a valid ID, converts
@@ -98,14 +119,8 @@ def process_file(filename, output_dir):
                 # Check if the ID has exactly 4 digits
                 if len(id) == 4 and id.isdigit():
                     idWithChecksum_str = addChecksum(id)
-                    lcdPartern_number = convertToLcdPartern(idWithChecksum_str)
-                    if lcdPartern_number > 0:
-                        lcdPartern_number <<= 8
-                        lcdPartern_str = format(lcdPartern_number, '0256b')
-                        
-                        #let's pad 256 characters into a list                    
-                        png_data = []
-                        converForPngDataArray(png_data, lcdPartern_str)
+                    png_data = convertToPngData(idWithChecksum_str)
+                    if png_data:
                         png_writer = png.Writer(width=256, height=1, greyscale=True, bitdepth=8)
                         
                         file_path = directory_path + '/' + id + '.png'
@@ -0,0 +1,321 @@
+/**
+ * @file COutputDirectory.cpp
+ * @author Xing Jin
+ * @brief
+ * @version 0.1
+ * @date 2023-10-27
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "COutputDirectory.hpp"
+
+using namespace std;
+
+//The handle to resolve a relative path against the current folder
+#ifdef _WIN32
+static const int I_CURRENT_DIR = 0;
+#else
+static const int I_CURRENT_DIR = AT_FDCWD;
+#endif
+
+/**
+ * @brief Helper to create a directory, an existing directory is not an error
+ *
+ * @param parentDir the handle of parent directory(ignored on Windows)
+ * @param dirPath   the directory path, relative to parentDir on POSIX
+ * @return true     the directory exists after the call
+ * @return false    failed to create the directory
+ */
+static bool makeDirectory(int parentDir, const string& dirPath)
+{
+#ifdef _WIN32
+    (void)parentDir;
+    int result = _mkdir(dirPath.c_str());
+#else
+    int result = mkdirat(parentDir, dirPath.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+/**
+ * @brief Construct a new output directory, nothing is touched on disk until open() is called
+ *
+ * @param rootPath   the output root folder, empty for the current folder
+ * @param shardDepth the number of shard directory levels, 0 to write into the root directly
+ * @param shardMode  how shard directory names are derived from the file key
+ */
+COutputDirectory::COutputDirectory(const string& rootPath, unsigned int shardDepth, ShardMode shardMode)
+    : m_rootPath(rootPath.empty() ? "." : rootPath),
+      m_shardDepth(shardDepth > I_MAX_SHARD_DEPTH ? I_MAX_SHARD_DEPTH : shardDepth),
+      m_shardMode(shardMode),
+      m_rootDir(-1)
+{
+    //remove trailing separators, but keep a bare "/"
+    while (m_rootPath.length() > 1 && m_rootPath.back() == '/')
+    {
+        m_rootPath.pop_back();
+    }
+}
+
+/**
+ * @brief Destroy the output directory and close all cached directory handles
+ *
+ */
+COutputDirectory::~COutputDirectory()
+{
+#ifndef _WIN32
+    for (auto& shardDir : m_shardDirList)
+    {
+        close(shardDir.second);
+    }
+
+    if (m_rootDir >= 0)
+    {
+        close(m_rootDir);
+    }
+#endif
+}
+
+/**
+ * @brief Create the output root including missing parent folders, then open it for
+ * the file creation relative to it
+ *
+ * @return true     the root is ready for writing
+ * @return false    failed to create or open the root
+ */
+bool COutputDirectory::open()
+{
+    //create each level of the root path, the same as 'mkdir -p'
+    for (size_t pos = m_rootPath.find('/', 1); ; pos = m_rootPath.find('/', pos + 1))
+    {
+        if (!makeDirectory(I_CURRENT_DIR, m_rootPath.substr(0, pos)))
+        {
+            cerr << "Failed to create the output directory: " << m_rootPath.substr(0, pos) << endl;
+            return false;
+        }
+
+        if (pos == string::npos) break;
+    }
+
+#ifdef _WIN32
+    m_rootDir = 0;
+#else
+    m_rootDir = ::open(m_rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_rootDir < 0)
+    {
+        cerr << "Failed to open the output directory: " << m_rootPath << endl;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * @brief Get the shard directory path for a file key, i.e. "12/34" for key "1234" with
+ * depth 2 in prefix mode. A key shorter than the shard depth gets fewer levels.
+ *
+ * @param key       the file key, normally the ID
+ * @return string   the shard path relative to root, empty when sharding is off
+ */
+string COutputDirectory::getShardPath(const string& key) const
+{
+    string source = key;
+
+    if (m_shardMode == SHARD_HASH)
+    {
+        //32 bit FNV-1a, spreads sequential IDs evenly across the shard directories
+        uint32_t hash = 2166136261u;
+        for (char c : key)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 16777619u;
+        }
+
+        char hashBuf[9];
+        snprintf(hashBuf, sizeof(hashBuf), "%08x", hash);
+        source = hashBuf;
+    }
+
+    string shardPath;
+    for (unsigned int level = 0; level < m_shardDepth; level++)
+    {
+        size_t pos = level * I_SHARD_WIDTH;
+        if (pos + I_SHARD_WIDTH > source.length()) break;
+
+        if (!shardPath.empty()) shardPath += '/';
+        shardPath += source.substr(pos, I_SHARD_WIDTH);
+    }
+
+    return shardPath;
+}
+
+/**
+ * @brief Get the path of a file under the shard directory of the key, the root is left out
+ * when it is the current folder, i.e. "out/12/34/1234.png"
+ *
+ * @param key       the file key used for sharding
+ * @param fileName  the file name without any folder
+ * @return string   the file path
+ */
+string COutputDirectory::getFilePath(const string& key, const string& fileName) const
+{
+    string shardPath = getShardPath(key);
+    string filePath = shardPath.empty() ? fileName : shardPath + '/' + fileName;
+
+    if (m_rootPath == ".") return filePath;
+    return m_rootPath == "/" ? "/" + filePath : m_rootPath + '/' + filePath;
+}
+
+/**
+ * @brief Get the directory handle of a first level shard directory, it is created and opened
+ * on demand. At most I_MAX_OPEN_DIRS handles are cached, the least recently used one is closed
+ * when the cache is full, so the open file limit is never reached.
+ *
+ * @param dirName   the first level directory name
+ * @return int      the directory handle, -1 for failure. It is valid until the next call.
+ */
+int COutputDirectory::getShardDir(const string& dirName)
+{
+    if (auto search = m_shardDirs.find(dirName); search != m_shardDirs.end())
+    {
+        //move it to the front as the most recently used
+        m_shardDirList.splice(m_shardDirList.begin(), m_shardDirList, search->second);
+        return search->second->second;
+    }
+
+    if (!makeShardDir(m_rootDir, string(), dirName)) return -1;
+
+#ifdef _WIN32
+    int shardDir = 0;
+#else
+    int shardDir = openat(m_rootDir, dirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (shardDir < 0)
+    {
+        cerr << "Failed to open the shard directory: " << dirName << endl;
+        return -1;
+    }
+#endif
+
+    if (m_shardDirList.size() >= I_MAX_OPEN_DIRS)
+    {
+#ifndef _WIN32
+        close(m_shardDirList.back().second);
+#endif
+        m_shardDirs.erase(m_shardDirList.back().first);
+        m_shardDirList.pop_back();
+    }
+
+    m_shardDirList.emplace_front(dirName, shardDir);
+    m_shardDirs.emplace(dirName, m_shardDirList.begin());
+    return shardDir;
+}
+
+/**
+ * @brief Create a shard directory and its missing parents under an opened directory once,
+ * the created paths are remembered so a following file in the same shard costs set lookups only
+ *
+ * @param baseDir   the handle of the directory the path is relative to
+ * @param basePath  the path of baseDir relative to root, empty for the root itself
+ * @param dirPath   the directory path relative to baseDir
+ * @return true     the directory exists
+ * @return false    failed to create the directory
+ */
+bool COutputDirectory::makeShardDir(int baseDir, const string& basePath, const string& dirPath)
+{
+    string prefix = basePath.empty() ? string() : basePath + '/';
+    if (m_madeDirs.count(prefix + dirPath)) return true;
+
+    //create each missing level from the top, the same as 'mkdir -p'
+    for (size_t pos = dirPath.find('/'); ; pos = dirPath.find('/', pos + 1))
+    {
+        string levelPath = dirPath.substr(0, pos);
+        if (!m_madeDirs.count(prefix + levelPath))
+        {
+#ifdef _WIN32
+            bool result = makeDirectory(baseDir, m_rootPath + '/' + prefix + levelPath);
+#else
+            bool result = makeDirectory(baseDir, levelPath);
+#endif
+            if (!result)
+            {
+                cerr << "Failed to create the shard directory: " << prefix + levelPath << endl;
+                return false;
+            }
+
+            m_madeDirs.insert(prefix + levelPath);
+        }
+
+        if (pos == string::npos) break;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Create(or truncate) a file for binary writing under the shard directory of the key,
+ * the file is opened relative to the cached first level shard directory
+ *
+ * @param key       the file key used for sharding
+ * @param fileName  the file name without any folder
+ * @return FILE*    the opened file, nullptr for failure. The caller should close it.
+ */
+FILE* COutputDirectory::createFile(const string& key, const string& fileName)
+{
+    if (m_rootDir < 0)
+    {
+        cerr << "The output directory is not opened." << endl;
+        return nullptr;
+    }
+
+    string shardPath = getShardPath(key);
+    string filePath = fileName;
+    int baseDir = m_rootDir;
+
+    size_t sepPos = shardPath.find('/');
+    if (sepPos != string::npos)
+    {
+        //deeper levels are resolved by openat() relative to the first level
+        string firstLevel = shardPath.substr(0, sepPos);
+        string restPath = shardPath.substr(sepPos + 1);
+
+        baseDir = getShardDir(firstLevel);
+        if (baseDir < 0 || !makeShardDir(baseDir, firstLevel, restPath)) return nullptr;
+
+        filePath = restPath + '/' + fileName;
+    }
+    else if (!shardPath.empty())
+    {
+        //a single level is created under root directly
+        if (!makeShardDir(m_rootDir, string(), shardPath)) return nullptr;
+
+        filePath = shardPath + '/' + fileName;
+    }
+
+#ifdef _WIN32
+    (void)baseDir;
+    return fopen(getFilePath(key, fileName).c_str(), "wb");
+#else
+    int fileHandle = openat(baseDir, filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fileHandle < 0) return nullptr;
+
+    FILE* filePtr = fdopen(fileHandle, "wb");
+    if (!filePtr)
+    {
+        close(fileHandle);
+    }
+
+    return filePtr;
+#endif
+}
@@ -0,0 +1,87 @@
+/**
+ * @file COutputDirectory.hpp
+ * @author Xing Jin
+ * @brief  The header file for the output directory class COutputDirectory
+ * @version 0.1
+ * @date 2023-10-27
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#pragma once
+
+#include <cstdio>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * @brief The output root for generated files, optionally sharded into sub directories
+ * like <root>/12/34/1234.png. On POSIX the root and the first level shard directories are kept
+ * open as directory handles, and each file is created with openat() as "34/1234.png" relative
+ * to its first level handle, so the root path is never resolved again.
+ * Only the first level is cached because it is the only one reused across many files: with 2
+ * characters per level it has at most 256 directories, while a deeper level has up to 256 times
+ * more and a handle cache over it would miss on almost every file and cost an extra open/close.
+ * The deeper directories are created once with mkdirat() and remembered by path instead.
+ *
+ */
+class COutputDirectory
+{
+public:
+    //How the shard directories are derived from a file key
+    enum ShardMode
+    {
+        SHARD_PREFIX,   //leading characters of the key, e.g. 1234 -> 12/34
+        SHARD_HASH      //hex digits of a FNV-1a hash of the key
+    };
+
+    //The characters used for each level of shard directory
+    static const unsigned int I_SHARD_WIDTH     = 2;
+    //The deepest supported shard level(8 hex digits of a 32 bit hash)
+    static const unsigned int I_MAX_SHARD_DEPTH = 4;
+    //The most first level handles kept open(all 256 hex names), the least recently used is closed first
+    static const unsigned int I_MAX_OPEN_DIRS   = 256;
+
+    COutputDirectory(const std::string&, unsigned int, ShardMode);
+    ~COutputDirectory();
+
+    COutputDirectory(const COutputDirectory&) = delete;
+    COutputDirectory& operator=(const COutputDirectory&) = delete;
+
+    //Create the output root if needed and open it
+    bool open();
+
+    //Get the shard directory path(relative to the root) for a file key
+    std::string getShardPath(const std::string&) const;
+
+    //Get the path of a file under the shard directory of the given key, including the root
+    std::string getFilePath(const std::string&, const std::string&) const;
+
+    //Create a file for writing under the shard directory of the given key
+    FILE* createFile(const std::string&, const std::string&);
+
+private:
+    //Get the cached handle of a first level shard directory, creating and opening it on demand
+    int getShardDir(const std::string&);
+
+    //Make sure a shard directory and its parents exist under an opened directory
+    bool makeShardDir(int, const std::string&, const std::string&);
+
+    std::string m_rootPath;
+    unsigned int m_shardDepth;
+    ShardMode m_shardMode;
+
+    //root directory handle, -1 if not opened
+    int m_rootDir;
+
+    //opened first level shard directories, the most recently used at the front
+    std::list<std::pair<std::string, int>> m_shardDirList;
+
+    //shard path relative to root -> position in m_shardDirList
+    std::unordered_map<std::string, std::list<std::pair<std::string, int>>::iterator> m_shardDirs;
+
+    //shard paths already created
+    std::unordered_set<std::string> m_madeDirs;
+};
@@ -132,7 +132,7 @@ bool CUtility::isValidId(const std::string& idStr, unsigned int idLength)
 
 /**
  * @brief The function is to generate an 1 bit width(0 white, 1 black) PNG file based on given file name and data.
- * libpng is used in the function, and code is referenced to an example from libpng.org   
+ * The file is created here and the image is written by the FILE* overload.
  * 
  * @param fileName  the file name and path of the PNG file
  * @param imgWidth  the width of the pixels 
@@ -152,6 +152,30 @@ bool CUtility::createPngImage1BitDepth(const string& fileName, int imgWidth, int
         return false;
     }
 
+    bool result = createPngImage1BitDepth(pngFilePtr, imgWidth, imgHeight, data);
+    fclose(pngFilePtr);
+
+    if (result)
+    {
+        std::cout << "PNG image created: " << fileName << std::endl;
+    }
+
+    return result;
+}
+
+/**
+ * @brief The function is to write an 1 bit width(0 white, 1 black) PNG image into an opened file.
+ * libpng is used in the function, and code is referenced to an example from libpng.org   
+ * 
+ * @param pngFilePtr the file opened for binary writing, it is not closed by the function
+ * @param imgWidth   the width of the pixels 
+ * @param imgHeight  the height of the pixel  
+ * @param data       the image data stored in a string buffer
+ * @return true      file generation suceeds
+ * @return false     failed to generate the png file 
+ */
+bool CUtility::createPngImage1BitDepth(FILE* pngFilePtr, int imgWidth, int imgHeight, string& data) 
+{
     // Initialize the PNG write structure
     png_structp pngStructPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!pngStructPtr) 
@@ -165,6 +189,7 @@ bool CUtility::createPngImage1BitDepth(const string& fileName, int imgWidth, int
     if (!pngInfo) 
     {
         cerr << "Failed to initialize the PNG info structure." << std::endl;
+        png_destroy_write_struct(&pngStructPtr, NULL);
         return false;
     }
 
@@ -172,6 +197,7 @@ bool CUtility::createPngImage1BitDepth(const string& fileName, int imgWidth, int
     if (setjmp(png_jmpbuf(pngStructPtr))) 
     {
         cerr << "Error during PNG creation." << std::endl;
+        png_destroy_write_struct(&pngStructPtr, &pngInfo);
         return false;
     }
 
@@ -202,15 +228,9 @@ bool CUtility::createPngImage1BitDepth(const string& fileName, int imgWidth, int
 
     // End writing
     png_write_end(pngStructPtr, NULL);
-    fclose(pngFilePtr);
 
     // Clean up resource
-    if (pngStructPtr && pngInfo)
-    {
-        png_destroy_write_struct(&pngStructPtr, &pngInfo);
-    }
-
-    std::cout << "PNG image created: " << fileName << std::endl;
+    png_destroy_write_struct(&pngStructPtr, &pngInfo);
 
     return true;
 }
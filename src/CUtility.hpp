@@ -8,6 +8,7 @@
  * @copyright Copyright (c) 2023
  * 
  */
+#include <cstdio>
 #include <string>
 
 /**
@@ -29,6 +30,9 @@ public:
     //Create PNG file based on given file name and image data
     static bool createPngImage1BitDepth(const std::string&, int, int, std::string&);
 
+    //Write PNG image data into an opened file
+    static bool createPngImage1BitDepth(FILE*, int, int, std::string&);
+
     //Check if a string contains digits only
     static inline bool isFullDigitString(const std::string& inputStr)
     {
@@ -4,7 +4,8 @@
  * @brief This is the entry point of the application. Main purpose of this application is to: 
  * 1. Retrieve 4 digit IDs from a text file, prefix 2 digit checksum to makeup a 6 digits
  * 2. Convert the 6 digit number to a bit partern which can be recognized by LCD model
- * 3. Save the bit partern to a png file named after the 4 digit ID
+ * 3. Save the bit partern to a png file named after the 4 digit ID, under an optional output
+ *    folder(-o) and optionally sharded into sub folders(-d depth, -s prefix|hash), e.g. 12/34/1234.png
  * 4. the png file formate is 1 bit depth(0 as white and 1 as black), 256 pixel width, 1 pixel height 
  * 
  * Dependency: libpng and its dependency zlib(http://www.libpng.org/pub/png/libpng.html)           
@@ -21,6 +22,7 @@
 #include <string>
 #include <set>
 #include "CUtility.hpp"
+#include "COutputDirectory.hpp"
 
 using namespace std;
 
@@ -52,7 +54,11 @@ const unsigned int  I_PNG_WIDTH         = 256;
 const unsigned int  I_PNG_HEIGHT         = 1;
 
 /**
- * @brief Main entry function, expecting one input argument as the ID text file along with excutable  
+ * @brief Main entry function, expecting the ID text file as the first input argument along with excutable,
+ * followed by the optional arguments:
+ *   -o <folder>        the output folder, current folder by default
+ *   -d <depth>         the levels of shard sub folders, 0(no sharding) by default
+ *   -s <prefix|hash>   name shard folders by leading digits of the ID or by its hash, prefix by default
  * 
  * @param argc  number of input arguments 
  * @param argv  the set of input argument in string
@@ -64,11 +70,47 @@ int main(int argc, char* argv[])
     if(argc < 2)
     {
         //missing file name in the input
-        cerr << "Usage: idToPngTest <filename>" << endl;
+        cerr << "Usage: idToPngTest <filename> [-o <folder>] [-d <depth>] [-s <prefix|hash>]" << endl;
         return 0; // Exit with an error code
     }
 
     string txtFilePath = argv[1];
+
+    //Parsing the optional arguments for output folder layout
+    string outputPath;
+    unsigned int shardDepth = 0;
+    COutputDirectory::ShardMode shardMode = COutputDirectory::SHARD_PREFIX;
+
+    for (int i = 2; i < argc; i++)
+    {
+        string option = argv[i];
+        if (i + 1 >= argc)
+        {
+            cerr << "Missing value for the argument: " << option << endl;
+            return 0;
+        }
+
+        string value = argv[++i];
+        if (option == "-o")
+        {
+            outputPath = value;
+        }
+        else if (option == "-d" && CUtility::isFullDigitString(value) && !value.empty()
+              && value.length() <= 2 && stoul(value) <= COutputDirectory::I_MAX_SHARD_DEPTH)
+        {
+            shardDepth = stoul(value);
+        }
+        else if (option == "-s" && (value == "prefix" || value == "hash"))
+        {
+            shardMode = value == "hash" ? COutputDirectory::SHARD_HASH : COutputDirectory::SHARD_PREFIX;
+        }
+        else
+        {
+            cerr << "Invalid argument: " << option << " " << value << endl;
+            return 0;
+        }
+    }
+
     ifstream txtFile(txtFilePath);
     if (!txtFile.is_open()) 
     {
@@ -76,6 +118,13 @@ int main(int argc, char* argv[])
         return 0; // Exit with an error code
     }
 
+    //Create the output folder only after the input file is ready
+    COutputDirectory outputDir(outputPath, shardDepth, shardMode);
+    if (!outputDir.open())
+    {
+        return 0; // Exit with an error code
+    }
+
     //local string variables
     string idLineStr, checkSumStr, finalDigitStr, decDisplayStr, pngNameStr; 
 
@@ -128,12 +177,23 @@ int main(int argc, char* argv[])
 
         // Now we are ready to generate the png file, finger crossed!
         pngNameStr = idLineStr + ".png";
-        if(!CUtility::createPngImage1BitDepth(pngNameStr, I_PNG_WIDTH, I_PNG_HEIGHT, pngImageData))
+        FILE* pngFilePtr = outputDir.createFile(idLineStr, pngNameStr);
+        if(!pngFilePtr)
+        {
+            cerr << "Failed to create png file: " << pngNameStr << endl; 
+            continue;
+        }
+
+        bool pngResult = CUtility::createPngImage1BitDepth(pngFilePtr, I_PNG_WIDTH, I_PNG_HEIGHT, pngImageData);
+        fclose(pngFilePtr);
+        if(!pngResult)
         {
             //error found during converting from digit to decimal display formate
             cerr << "Failed to create png file: " << pngNameStr << endl; 
             continue;
         }
+
+        cout << "PNG image created: " << outputDir.getFilePath(idLineStr, pngNameStr) << endl;
     }
 
     txtFile.close(); // Close the txt file
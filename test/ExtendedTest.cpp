@@ -0,0 +1,556 @@
+/**
+ * @file ExtendedTest.cpp
+ * @author Xing Jin
+ * @brief An extended test application running through every 4 digit ID, it supports 3 modes:
+ *        exhaustive  compare CUtility and the png files of LcdPngGenerator against reference functions
+ *        python      compare the png files of LcdPngGenerator against the python implementation
+ *        performance measure the rate of LcdPngGenerator and compare it with a stored baseline
+ * @version 0.1
+ * @date 2023-10-27
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <png.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "CUtility.hpp"
+
+using namespace std;
+
+/**
+ * @brief Constants of the current ID formate, the same as LcdPngGenerator
+ *
+ */
+const unsigned int TEST_ID_LEN          = 4;
+const unsigned int TEST_ID_COUNT        = 10000;
+const unsigned int TEST_CHECKSUM_MOD    = 97;
+const unsigned int TEST_CHECKSUM_LEN    = 2;
+const unsigned int TEST_IMAGE_PIXELS    = 256;
+const unsigned int TEST_IMAGE_HEIGHT    = 1;
+const unsigned int TEST_IMAGE_OFFSET    = 1;
+
+/**
+ * @brief The number of timed rounds in performance mode, the fastest one is taken to reduce noise
+ *
+ */
+const unsigned int TEST_PERF_ROUNDS     = 7;
+
+/**
+ * @brief The exit code for ctest to report the performance test as skipped, when there was no
+ * baseline to compare and it has just been recorded
+ *
+ */
+const int TEST_SKIP_CODE                = 77;
+
+/**
+ * @brief Reference LCD bit partern of digit 0 to 9, written down separately from CUtility
+ *
+ */
+const unsigned char C_RefDisplay[10] = {0x77, 0x42, 0xB6, 0xD6, 0xC3, 0xD5, 0xF5, 0x46, 0xF7, 0xD7};
+
+/**
+ * @brief Get the zero padded 4 digit ID string of a number
+ *
+ * @param number    the number from 0 to 9999
+ * @return string   the ID string
+ */
+string formatId(unsigned int number)
+{
+    char idBuf[TEST_ID_LEN + 1];
+    snprintf(idBuf, sizeof(idBuf), "%04u", number);
+    return idBuf;
+}
+
+/**
+ * @brief Reference of the ID with checksum prefixed, calculated digit by digit
+ *
+ * @param idStr     the ID string
+ * @return string   the checksum followed by the ID
+ */
+string refIdWithChecksum(const string& idStr)
+{
+    unsigned int checkSum = 0;
+    for (auto it = idStr.rbegin(); it != idStr.rend(); ++it)
+    {
+        checkSum = (checkSum * 10 + (*it - '0')) % TEST_CHECKSUM_MOD;
+    }
+
+    return string(1, '0' + checkSum / 10) + string(1, '0' + checkSum % 10) + idStr;
+}
+
+/**
+ * @brief Reference of the png image data for an ID with checksum
+ *
+ * @param digitStr  the ID with checksum
+ * @return string   the image data of one row
+ */
+string refImageData(const string& digitStr)
+{
+    string imageData(TEST_IMAGE_PIXELS / 8, '\0');
+    for (size_t i = 0; i < digitStr.length(); i++)
+    {
+        imageData[TEST_IMAGE_OFFSET + i] = C_RefDisplay[digitStr[i] - '0'];
+    }
+
+    return imageData;
+}
+
+/**
+ * @brief Generate the payload of an ID in the same way as LcdPngGenerator
+ *
+ * @param idStr         the ID string
+ * @param digitStr      the ID with checksum
+ * @param imageData     the image data of one row
+ * @return true         succeed
+ * @return false        failed in one of the steps
+ */
+bool generatePayload(const string& idStr, string& digitStr, string& imageData)
+{
+    string checkSumStr, decDisplayStr;
+
+    if (!CUtility::isValidId(idStr, TEST_ID_LEN)) return false;
+    if (!CUtility::getChecksumCode(idStr, checkSumStr, TEST_CHECKSUM_MOD, TEST_CHECKSUM_LEN)) return false;
+
+    digitStr = checkSumStr + idStr;
+    if (!CUtility::convertStringToDecDisplay(digitStr, decDisplayStr)) return false;
+
+    imageData.assign(TEST_IMAGE_PIXELS / 8, '\0');
+    imageData.replace(TEST_IMAGE_OFFSET, decDisplayStr.length(), decDisplayStr);
+    return true;
+}
+
+/**
+ * @brief Reference of the shard path of an ID with 2 levels in prefix mode, i.e. "12/34"
+ *
+ * @param idStr     the ID string
+ * @return string   the shard path
+ */
+string refShardPath(const string& idStr)
+{
+    return idStr.substr(0, 2) + "/" + idStr.substr(2, 2);
+}
+
+/**
+ * @brief Write a file of all IDs, one per line, followed by extra lines
+ *
+ * @param fileName      the file name and path
+ * @param extraLines    the lines appended after all IDs
+ * @return true         succeed
+ * @return false        failed to write the file
+ */
+bool writeIdFile(const string& fileName, const vector<string>& extraLines)
+{
+    ofstream idFile(fileName);
+    for (unsigned int number = 0; number < TEST_ID_COUNT; number++)
+    {
+        idFile << formatId(number) << "\n";
+    }
+
+    for (const string& line : extraLines)
+    {
+        idFile << line << "\n";
+    }
+
+    return idFile.good();
+}
+
+/**
+ * @brief Run the LcdPngGenerator executable, its output is saved to a log file
+ *
+ * @param generatorPath the path of the LcdPngGenerator executable
+ * @param idFile        the ID file to be processed
+ * @param outputPath    the output folder passed by -o
+ * @param arguments     the other arguments, i.e. "-d 2"
+ * @param logFile       the file for the output of the generator
+ * @return true         the generator exits normally
+ * @return false        failed to run the generator
+ */
+bool runGenerator(const string& generatorPath, const string& idFile, const string& outputPath,
+                  const string& arguments, const string& logFile)
+{
+    string command = "\"" + generatorPath + "\" \"" + idFile + "\" -o \"" + outputPath + "\" "
+                   + arguments + " > \"" + logFile + "\" 2>&1";
+
+    if (system(command.c_str()) != 0)
+    {
+        cout << "failed to run " << command << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Read the single row of a png file back to image data
+ *
+ * @param fileName  the png file name and path
+ * @param imageData the image data read from the file
+ * @return true     succeed in reading a png in expected formate
+ * @return false    failed to read the file or the formate is not correct
+ */
+bool readPngRow(const string& fileName, string& imageData)
+{
+    FILE* filePtr = fopen(fileName.c_str(), "rb");
+    if (!filePtr) return false;
+
+    png_structp pngStructPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop pngInfo = pngStructPtr ? png_create_info_struct(pngStructPtr) : NULL;
+    if (!pngInfo || setjmp(png_jmpbuf(pngStructPtr)))
+    {
+        png_destroy_read_struct(&pngStructPtr, &pngInfo, NULL);
+        fclose(filePtr);
+        return false;
+    }
+
+    png_init_io(pngStructPtr, filePtr);
+    png_read_info(pngStructPtr, pngInfo);
+
+    bool result = png_get_image_width(pngStructPtr, pngInfo) == TEST_IMAGE_PIXELS
+               && png_get_image_height(pngStructPtr, pngInfo) == TEST_IMAGE_HEIGHT
+               && png_get_color_type(pngStructPtr, pngInfo) == PNG_COLOR_TYPE_GRAY
+               && png_get_bit_depth(pngStructPtr, pngInfo) == 1;
+
+    if (result)
+    {
+        //the image was inverted during writing, revert it back to the original data
+        png_set_invert_mono(pngStructPtr);
+
+        imageData.assign(png_get_rowbytes(pngStructPtr, pngInfo), '\0');
+        png_read_row(pngStructPtr, reinterpret_cast<png_bytep>(imageData.data()), NULL);
+    }
+
+    png_destroy_read_struct(&pngStructPtr, &pngInfo, NULL);
+    fclose(filePtr);
+    return result;
+}
+
+/**
+ * @brief Compare CUtility against the reference functions for every ID, then run LcdPngGenerator
+ * over all IDs with 2 levels of shard folders and compare every png file it writes against the
+ * reference image data. Duplicated and invalid IDs are appended to the ID file as well.
+ *
+ * @param generatorPath the path of the LcdPngGenerator executable
+ * @return true         Testing succeed
+ * @return false        Testing failed
+ */
+bool TestExhaustive(const string& generatorPath)
+{
+    string idStr, digitStr, imageData, fileData;
+    bool testResult(false);
+
+    cout << "Test all " << TEST_ID_COUNT << " IDs against reference: ";
+
+    const string outputPath = "extended_test/exhaustive";
+    const vector<string> invalidIds = {"12a4", "12345", "123", ""};
+
+    while(1)
+    {
+        //function level check of CUtility
+        unsigned int number = 0;
+        for (; number < TEST_ID_COUNT; number++)
+        {
+            idStr = formatId(number);
+            if (!generatePayload(idStr, digitStr, imageData)) break;
+            if (digitStr != refIdWithChecksum(idStr)) break;
+            if (imageData != refImageData(digitStr)) break;
+        }
+        if (number != TEST_ID_COUNT) break;
+
+        //files written by the real executable
+        idStr.clear();
+        filesystem::remove_all(outputPath);
+        filesystem::create_directories(outputPath);
+
+        vector<string> extraLines = invalidIds;
+        extraLines.push_back("1337");
+        if (!writeIdFile("extended_test/exhaustive_ids.txt", extraLines)) break;
+        if (!runGenerator(generatorPath, "extended_test/exhaustive_ids.txt", outputPath, "-d 2",
+                          "extended_test/exhaustive.log")) break;
+
+        for (number = 0; number < TEST_ID_COUNT; number++)
+        {
+            idStr = formatId(number);
+            string fileName = outputPath + "/" + refShardPath(idStr) + "/" + idStr + ".png";
+            if (!readPngRow(fileName, fileData)) break;
+            if (fileData != refImageData(refIdWithChecksum(idStr))) break;
+        }
+        if (number != TEST_ID_COUNT) break;
+
+        //nothing else should be written, i.e. no png for an invalid ID
+        size_t fileCount = 0;
+        for (auto& entry : filesystem::recursive_directory_iterator(outputPath))
+        {
+            if (entry.is_regular_file()) fileCount++;
+        }
+        idStr = "invalid ones";
+        if (fileCount != TEST_ID_COUNT) break;
+
+        testResult = true;
+        break;
+    }
+
+    string resultString = testResult ? "passed" : "failed at id " + idStr;
+    cout << resultString << endl;
+
+    return testResult;
+}
+
+/**
+ * @brief Run LcdPngGenerator over all IDs and compare the checksum, the LCD partern and the png row
+ * it writes against the output of PyReferenceDump.py, which comes from PyIdToLcdPng
+ *
+ * @param generatorPath the path of the LcdPngGenerator executable
+ * @param pythonCmd     the python interpreter
+ * @param scriptPath    the path of PyReferenceDump.py
+ * @return true         Testing succeed
+ * @return false        Testing failed
+ */
+bool TestPythonReference(const string& generatorPath, const string& pythonCmd, const string& scriptPath)
+{
+    string idStr, digitStr, imageData, fileData;
+    bool testResult(false);
+
+    cout << "Test all " << TEST_ID_COUNT << " IDs against python: ";
+
+    const string outputPath = "extended_test/python";
+    filesystem::remove_all(outputPath);
+    filesystem::create_directories(outputPath);
+
+    if (!writeIdFile("extended_test/python_ids.txt", {})
+     || !runGenerator(generatorPath, "extended_test/python_ids.txt", outputPath, "", "extended_test/python.log"))
+    {
+        return false;
+    }
+
+    string command = "\"" + pythonCmd + "\" \"" + scriptPath + "\"";
+    FILE* pipePtr = popen(command.c_str(), "r");
+    if (!pipePtr)
+    {
+        cout << "failed to run " << command << endl;
+        return false;
+    }
+
+    char lineBuf[512];
+    unsigned int number = 0;
+    string failure;
+    while (number < TEST_ID_COUNT && fgets(lineBuf, sizeof(lineBuf), pipePtr))
+    {
+        istringstream lineStream(lineBuf);
+        string pyIdStr, pyDigitStr, pyPartern, pyRow;
+        lineStream >> pyIdStr >> pyDigitStr >> pyPartern >> pyRow;
+
+        idStr = formatId(number);
+        if (pyIdStr != idStr || !generatePayload(idStr, digitStr, imageData)) break;
+
+        failure = "checksum";
+        if (pyDigitStr != digitStr) break;
+
+        //python keeps the LCD partern as a big endian number
+        failure = "LCD partern";
+        char partern[13];
+        for (size_t i = 0; i < digitStr.length(); i++)
+        {
+            snprintf(partern + i * 2, 3, "%02x", static_cast<unsigned char>(imageData[TEST_IMAGE_OFFSET + i]));
+        }
+        if (pyPartern != partern) break;
+
+        //the png row written by LcdPngGenerator, pixels from left to right
+        failure = "png row";
+        if (!readPngRow(outputPath + "/" + idStr + ".png", fileData)) break;
+
+        string row;
+        for (unsigned char c : fileData)
+        {
+            for (int bit = 7; bit >= 0; bit--) row += (c >> bit) & 1 ? '1' : '0';
+        }
+        if (pyRow != row) break;
+
+        failure.clear();
+        number++;
+    }
+
+    int exitCode = pclose(pipePtr);
+    testResult = number == TEST_ID_COUNT && exitCode == 0;
+
+    string resultString = testResult ? "passed" : "failed at id " + idStr + (failure.empty() ? "" : " on " + failure);
+    cout << resultString << endl;
+
+    return testResult;
+}
+
+/**
+ * @brief Get the time spent by finished child processes. On POSIX it is the user and system CPU
+ * time, so time waiting for other processes on a busy machine is left out. Windows falls back to
+ * the wall clock.
+ *
+ * @return double   the time in seconds
+ */
+double getChildTime()
+{
+#ifdef _WIN32
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+/**
+ * @brief The output layouts timed by the performance test, each has its own baseline entry
+ *
+ */
+const vector<pair<string, string>> C_PerfLayouts
+{
+    {"flat",    ""},
+    {"prefix",  "-d 2"},
+    {"hash",    "-d 2 -s hash"}
+};
+
+/**
+ * @brief Measure the end-to-end rate of the LcdPngGenerator executable over a file of all IDs in
+ * each output layout and compare them with the baseline. The baseline file keeps one line of
+ * '<layout> <IDs per second>' per layout, a missing layout is recorded and not compared.
+ *
+ * @param generatorPath the path of the LcdPngGenerator executable
+ * @param baselineFile  the path of the baseline file
+ * @param threshold     the allowed drop from the baseline in percent
+ * @param outputPath    the folder for the generated files, a memory file system keeps disk noise out
+ * @param recorded      set to true when any baseline is recorded instead of compared
+ * @return true         Testing succeed
+ * @return false        Testing failed
+ */
+bool TestPerformance(const string& generatorPath, const string& baselineFile, double threshold,
+                     const string& outputPath, bool& recorded)
+{
+    bool testResult(true);
+    recorded = false;
+
+    cout << "Test end-to-end performance:" << endl;
+
+    map<string, double> baselineRates;
+    ifstream baselineIn(baselineFile);
+    string layoutName;
+    double layoutRate;
+    while (baselineIn >> layoutName >> layoutRate)
+    {
+        baselineRates[layoutName] = layoutRate;
+    }
+    baselineIn.close();
+
+    filesystem::create_directories(outputPath);
+    string idFile = outputPath + "/perf_ids.txt";
+    if (!writeIdFile(idFile, {}))
+    {
+        cout << "failed to create the ID file" << endl;
+        return false;
+    }
+
+    for (auto& layout : C_PerfLayouts)
+    {
+        string layoutPath = outputPath + "/" + layout.first;
+        vector<double> rates;
+
+        for (unsigned int round = 0; round < TEST_PERF_ROUNDS; round++)
+        {
+            //every round creates the folders and files from scratch
+            filesystem::remove_all(layoutPath);
+
+            double startTime = getChildTime();
+
+            if (!runGenerator(generatorPath, idFile, layoutPath, layout.second, outputPath + "/perf_generator.log"))
+            {
+                return false;
+            }
+
+            rates.push_back(TEST_ID_COUNT / (getChildTime() - startTime));
+        }
+
+        filesystem::remove_all(layoutPath);
+
+        double bestRate = *max_element(rates.begin(), rates.end());
+
+        cout << "  " << layout.first << " '" << layout.second << "': " << bestRate << " IDs/s, ";
+
+        if (auto search = baselineRates.find(layout.first); search != baselineRates.end() && search->second > 0)
+        {
+            double minRate = search->second * (1 - threshold / 100);
+            bool layoutResult = bestRate >= minRate;
+            testResult = testResult && layoutResult;
+            cout << "baseline " << search->second << " IDs/s, minimum " << minRate << " IDs/s: "
+                 << (layoutResult ? "passed" : "failed") << endl;
+        }
+        else
+        {
+            //no baseline yet, record the current rate for following runs
+            baselineRates[layout.first] = bestRate;
+            recorded = true;
+            cout << "no baseline to compare, recorded" << endl;
+        }
+    }
+
+    if (recorded)
+    {
+        ofstream baselineOut(baselineFile);
+        for (auto& baselineRate : baselineRates)
+        {
+            baselineOut << baselineRate.first << " " << baselineRate.second << endl;
+        }
+
+        if (!baselineOut.good())
+        {
+            cout << "failed to record the baseline to " << baselineFile << endl;
+            return false;
+        }
+        cout << "baseline recorded to " << baselineFile << endl;
+    }
+
+    string resultString = !testResult ? "failed" : recorded ? "skipped" : "passed";
+    cout << "Test end-to-end performance: " << resultString << endl;
+
+    return testResult;
+}
+
+int main(int argc, char* argv[])
+{
+    string mode = argc > 1 ? argv[1] : "";
+    bool testResult(false);
+
+    if (mode == "exhaustive" && argc > 2)
+    {
+        testResult = TestExhaustive(argv[2]);
+    }
+    else if (mode == "python" && argc > 4)
+    {
+        testResult = TestPythonReference(argv[2], argv[3], argv[4]);
+    }
+    else if (mode == "performance" && argc > 4)
+    {
+        bool recorded(false);
+        testResult = TestPerformance(argv[2], argv[3], atof(argv[4]),
+                                     argc > 5 ? argv[5] : "extended_test/performance", recorded);
+        if (testResult && recorded) return TEST_SKIP_CODE;
+    }
+    else
+    {
+        cerr << "Usage: ExtendedTest exhaustive <LcdPngGenerator>" << endl;
+        cerr << "       ExtendedTest python <LcdPngGenerator> <python> <PyReferenceDump.py>" << endl;
+        cerr << "       ExtendedTest performance <LcdPngGenerator> <baseline file> <threshold percent> [output folder]" << endl;
+    }
+
+    return testResult ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+import os
+import sys
+import types
+
+# Only the pure conversion functions of PyIdToLcdPng are used here, so a stub of pypng is
+# enough when it is not installed.
+try:
+    import png
+except ImportError:
+    sys.modules["png"] = types.ModuleType("png")
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "python"))
+
+from PyIdToLcdPng import addChecksum, convertToLcdPartern, convertToPngData
+
+def main():
+    """
+    The main function prints one line per 4-digit ID from 0000 to 9999 in the form of
+    '<id> <id with checksum> <lcd partern in 12 hex digits> <png row>', which is compared against the
+    C++ implementation by ExtendedTest. The png row is the row written by PyIdToLcdPng in 256
+    characters, '1' for a black pixel and '0' for a white one.
+    """
+    for number in range(10000):
+        id = f"{number:04d}"
+        idWithChecksum_str = addChecksum(id)
+        lcdPartern_number = convertToLcdPartern(idWithChecksum_str)
+        png_row = "".join("1" if pixel == 0 else "0" for pixel in convertToPngData(idWithChecksum_str)[0])
+        print(f"{id} {idWithChecksum_str} {lcdPartern_number:012x} {png_row}")
+
+if __name__ == "__main__":
+    main()
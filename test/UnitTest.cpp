@@ -12,8 +12,12 @@
 #include <iostream>
 #include <cstring>
 #include <png.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 
 #include "CUtility.hpp"
+#include "COutputDirectory.hpp"
 
 using namespace std;
 
@@ -200,27 +204,36 @@ bool readAndCheckPngFile(const string& fileName, const char* imgBuf)
         return false;
     }
 
+    //the image was inverted during writing, revert it back to the original data
+    png_set_invert_mono(pngStructPtr);
+
+    size_t rowBytes = png_get_rowbytes(pngStructPtr, pngInfo);
     png_bytep *row_pointers = NULL;
     row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
     for(int y = 0; y < height; y++) 
     {
-        row_pointers[y] = (png_byte*)malloc(png_get_rowbytes(pngStructPtr, pngInfo));
+        row_pointers[y] = (png_byte*)malloc(rowBytes);
     }
 
     png_read_image(pngStructPtr, row_pointers);
 
-    /* temporarily disable the binary comparison test 
-        if(memcpy(const_cast<char*>(imgBuf), row_pointers, sizeof(row_pointers)) != 0)
+    bool dataResult = true;
+    for(int y = 0; y < height; y++) 
     {
-        cout << "png data is not correct" << endl;
-        return false;
+        if(memcmp(row_pointers[y], imgBuf + y * rowBytes, rowBytes) != 0) dataResult = false;
+        free(row_pointers[y]);
     }
-    */
+    free(row_pointers);
 
     fclose(filePtr);
     png_destroy_read_struct(&pngStructPtr, &pngInfo, NULL);
 
-    return true;
+    if(!dataResult)
+    {
+        cout << "png data is not correct" << endl;
+    }
+
+    return dataResult;
 }
 
 /**
@@ -270,6 +283,96 @@ bool TestPngGenerator()
     return testResult;
 }
 
+/**
+ * @brief Test cases for COutputDirectory by checking the shard paths and generating a png file
+ * into a sharded output folder
+ * 
+ * @return true     Testing succeed
+ * @return false    Testing failed
+ */
+bool TestOutputDirectory()
+{
+    string pngImageData(TEST_IMAGE_PIXELS/8, '\0'); 
+
+    string testString;
+    bool testResult(false);
+
+    cout << "Test output directory: ";
+
+    while(1)
+    {
+        testString = "1337";
+        if(COutputDirectory("", 0, COutputDirectory::SHARD_PREFIX).getShardPath(testString) != "") break;
+        if(COutputDirectory("", 1, COutputDirectory::SHARD_PREFIX).getShardPath(testString) != "13") break;
+        if(COutputDirectory("", 2, COutputDirectory::SHARD_PREFIX).getShardPath(testString) != "13/37") break;
+        if(COutputDirectory("", 3, COutputDirectory::SHARD_PREFIX).getShardPath(testString) != "13/37") break;
+        if(COutputDirectory("", 2, COutputDirectory::SHARD_HASH).getShardPath(testString).length() != 5) break;
+
+        //FNV-1a of "1337" is 0xe760aec7
+        if(COutputDirectory("", 4, COutputDirectory::SHARD_HASH).getShardPath(testString) != "e7/60/ae/c7") break;
+        if(COutputDirectory("", 2, COutputDirectory::SHARD_HASH).getShardPath(testString) != "e7/60") break;
+
+        string lcdString;
+        if(!CUtility::convertStringToDecDisplay("561337", lcdString)) break;
+        pngImageData.replace(1, lcdString.length(), lcdString);
+
+        COutputDirectory outputDir("shard_test/output/", 2, COutputDirectory::SHARD_PREFIX);
+        if(!outputDir.open()) break;
+
+        FILE* filePtr = outputDir.createFile(testString, "1337.png");
+        if(!filePtr) break;
+        bool pngResult = CUtility::createPngImage1BitDepth(filePtr, TEST_IMAGE_PIXELS, TEST_IMAGE_HEIGHT, pngImageData);
+        fclose(filePtr);
+        if(!pngResult) break;
+
+        if(!readAndCheckPngFile("shard_test/output/13/37/1337.png", pngImageData.c_str())) break;
+
+#ifndef _WIN32
+        //write more files into separate shards than the open file limit allows at once
+        rlimit fileLimit;
+        if(getrlimit(RLIMIT_NOFILE, &fileLimit) != 0) break;
+
+        rlimit testLimit = fileLimit;
+        testLimit.rlim_cur = COutputDirectory::I_MAX_OPEN_DIRS + 32;
+        if(fileLimit.rlim_cur < testLimit.rlim_cur) testLimit.rlim_cur = fileLimit.rlim_cur;
+        if(setrlimit(RLIMIT_NOFILE, &testLimit) != 0) break;
+
+        COutputDirectory prefixDir("shard_test/limit_prefix", 2, COutputDirectory::SHARD_PREFIX);
+        COutputDirectory hashDir("shard_test/limit_hash", 3, COutputDirectory::SHARD_HASH);
+        bool limitResult = prefixDir.open() && hashDir.open();
+
+        for(unsigned int i = 0; limitResult && i < testLimit.rlim_cur * 2; i++)
+        {
+            char idBuf[8];
+            snprintf(idBuf, sizeof(idBuf), "%04u", i);
+            testString = idBuf;
+
+            for(COutputDirectory* outputDir : {&prefixDir, &hashDir})
+            {
+                filePtr = outputDir->createFile(testString, testString + ".png");
+                if(!filePtr)
+                {
+                    limitResult = false;
+                    break;
+                }
+                fclose(filePtr);
+            }
+        }
+
+        setrlimit(RLIMIT_NOFILE, &fileLimit);
+        if(!limitResult) break;
+#endif
+
+        testResult = true;
+        break;
+    }    
+
+    string resultString = testResult ? "passed" : "failed at id " + testString;
+    cout << resultString << endl;
+
+    return testResult;
+}
+
 int main(int argc, char* argv[])
 {
     cout << "Unit test starts here." << endl; 
@@ -279,7 +382,8 @@ int main(int argc, char* argv[])
     if(TestChecksum() && 
        TestStringToDecDisplayConversion() && 
        TestIdValidation() &&
-       TestPngGenerator())
+       TestPngGenerator() &&
+       TestOutputDirectory())
     {
         testResult = 0;
     }